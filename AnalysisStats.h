@@ -0,0 +1,102 @@
+/*///////////////////////////////////////////////////////////////
+// Per-stage counters of the analyzers                         //
+// For the ANNIE Collaboration                                 //
+///////////////////////////////////////////////////////////////*/
+
+// PMTAnalysis, pmtLAPPD and TDCProcessor keep an AnalysisStats of their last run
+// (GetStats) and can print it as one short block (PrintStats), so production jobs
+// can log throughput and where the time went. Stage times are wall-clock seconds;
+// when worker threads run a stage side by side their times are added up.
+
+#ifndef AnalysisStats_H
+#define AnalysisStats_H
+
+#include <RtypesCore.h>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <sys/resource.h>
+
+enum AnalysisStage { kStageRead, kStageCutFill, kStageSortCluster, kStageWrite, kStageRender, kAnalysisStages };
+
+struct AnalysisStats {
+    Long64_t events;                        // Entries read
+    Long64_t hits;                          // Hits (or tdc values) in those entries
+    Long64_t bytesRead;                     // Bytes read from disk (compressed) or mapped from a hit cache
+    double stageSeconds[kAnalysisStages];
+    double wallSeconds;                     // Whole call, for the rates
+
+    AnalysisStats() { Reset(); }
+
+    void Reset() {
+        events = 0;
+        hits = 0;
+        bytesRead = 0;
+        for (double& seconds : stageSeconds) seconds = 0;
+        wallSeconds = 0;
+    }
+
+    // Add the counters of a worker; wallSeconds is left to the caller
+    void Add(const AnalysisStats& other) {
+        events += other.events;
+        hits += other.hits;
+        bytesRead += other.bytesRead;
+        for (int s = 0; s < kAnalysisStages; ++s) {
+            stageSeconds[s] += other.stageSeconds[s];
+        }
+    }
+
+    double GetEventRate() const { return wallSeconds > 0 ? events / wallSeconds : 0; }
+    double GetHitRate() const { return wallSeconds > 0 ? hits / wallSeconds : 0; }
+
+    // Peak resident set size of the process so far, in MB
+    static double GetPeakRSS() {
+        struct rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+        return usage.ru_maxrss / (1024. * 1024.);  // bytes
+#else
+        return usage.ru_maxrss / 1024.;            // kB
+#endif
+    }
+
+    void Print(const char* name) const {
+        static const char* kStageNames[kAnalysisStages] = {"read", "cut/fill", "sort/cluster", "write", "render"};
+        char line[256];
+        snprintf(line, sizeof(line), "%s: %lld events, %lld hits in %.3f s (%.0f events/s, %.0f hits/s)", name,
+                 (long long)events, (long long)hits, wallSeconds, GetEventRate(), GetHitRate());
+        std::cout << line << std::endl;
+        std::cout << " ";
+        for (int s = 0; s < kAnalysisStages; ++s) {
+            snprintf(line, sizeof(line), " %s %.3f s", kStageNames[s], stageSeconds[s]);
+            std::cout << line << (s + 1 < kAnalysisStages ? " |" : "");
+        }
+        std::cout << std::endl;
+        snprintf(line, sizeof(line), "  %.1f MB read, peak RSS %.1f MB", bytesRead / (1024. * 1024.), GetPeakRSS());
+        std::cout << line << std::endl;
+    }
+};
+
+// Stopwatch charging the time since the previous lap to a stage
+class AnalysisStageTimer {
+public:
+    explicit AnalysisStageTimer(AnalysisStats& stats) : fStats(stats), fStart(Clock::now()), fLast(fStart) {}
+
+    void Lap(AnalysisStage stage) {
+        Clock::time_point now = Clock::now();
+        fStats.stageSeconds[stage] += std::chrono::duration<double>(now - fLast).count();
+        fLast = now;
+    }
+
+    // Seconds since the timer was made
+    double Elapsed() const { return std::chrono::duration<double>(Clock::now() - fStart).count(); }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    AnalysisStats& fStats;
+    Clock::time_point fStart;
+    Clock::time_point fLast;
+};
+
+#endif // AnalysisStats_H
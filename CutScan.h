@@ -0,0 +1,113 @@
+/*///////////////////////////////////////////////////////////////
+// Cut configurations for scanning PMTAnalysis and pmtLAPPD    //
+// For the ANNIE Collaboration                                 //
+///////////////////////////////////////////////////////////////*/
+
+#ifndef CutScan_H
+#define CutScan_H
+
+#include <TFile.h>
+#include <TString.h>
+#include <TTree.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "HistogramBank.h"
+
+// One set of cuts. cutoff is the cutoff voltage for PMTAnalysis and the cutoff PE
+// for pmtLAPPD; cutOn is the cut-on PE of pmtLAPPD and is ignored by PMTAnalysis.
+struct CutConfig {
+    double startTime;
+    double endTime;
+    double cutoff;
+    double cutOn;
+};
+
+// Every combination of the given values
+inline std::vector<CutConfig> MakeCutGrid(const std::vector<double>& startTimes, const std::vector<double>& endTimes,
+                                          const std::vector<double>& cutoffs, const std::vector<double>& cutOns = {0}) {
+    std::vector<CutConfig> grid;
+    for (double startTime : startTimes) {
+        for (double endTime : endTimes) {
+            for (double cutoff : cutoffs) {
+                for (double cutOn : cutOns) {
+                    grid.push_back({startTime, endTime, cutoff, cutOn});
+                }
+            }
+        }
+    }
+    return grid;
+}
+
+// One row of the scan summary table: the hits of one PMT under one configuration
+struct CutScanRow {
+    int config;
+    double startTime;
+    double endTime;
+    double cutoff;
+    double cutOn;
+    int pmtID;
+    Long64_t nHits;
+    double meanPE;
+};
+
+// Book the summary tree in the current directory, with its branches bound to row
+inline TTree* BookCutScanSummary(CutScanRow& row) {
+    TTree* summary = new TTree("ScanSummary", "Hits per PMT and cut configuration");
+    summary->Branch("config", &row.config, "config/I");
+    summary->Branch("startTime", &row.startTime, "startTime/D");
+    summary->Branch("endTime", &row.endTime, "endTime/D");
+    summary->Branch("cutoff", &row.cutoff, "cutoff/D");
+    summary->Branch("cutOn", &row.cutOn, "cutOn/D");
+    summary->Branch("pmtID", &row.pmtID, "pmtID/I");
+    summary->Branch("nHits", &row.nHits, "nHits/L");
+    summary->Branch("meanPE", &row.meanPE, "meanPE/D");
+    return summary;
+}
+
+// Write the histogram sets of a scan to outputFileName. Set i goes to directory
+// "Config_<i>" through writeSet(set), and its pulseHeightDistributions bank gives the
+// ScanSummary rows: hits and mean PE of every PMT. The log line of each configuration
+// names its cuts with describeCuts(config).
+template <class HistogramSet, class WriteSet, class DescribeCuts>
+bool WriteCutScan(const std::string& outputFileName, const std::vector<CutConfig>& configs, std::vector<HistogramSet>& sets,
+                  WriteSet writeSet, DescribeCuts describeCuts) {
+    TFile* outputFile = new TFile(outputFileName.c_str(), "RECREATE");
+    if (!outputFile || outputFile->IsZombie()) {
+        std::cerr << "Error: Failed to create output file: " << outputFileName << std::endl;
+        delete outputFile;
+        return false;
+    }
+
+    CutScanRow row;
+    TTree* summary = BookCutScanSummary(row);
+    for (int i = 0; i < (int)configs.size(); ++i) {
+        TDirectory* configDir = outputFile->mkdir(Form("Config_%d", i));
+        configDir->cd();
+        writeSet(sets[i]);
+
+        Long64_t totalHits = 0;
+        row.config = i;
+        row.startTime = configs[i].startTime;
+        row.endTime = configs[i].endTime;
+        row.cutoff = configs[i].cutoff;
+        row.cutOn = configs[i].cutOn;
+        const HistogramBank& phd = sets[i].pulseHeightDistributions;
+        for (int j = 0; j < phd.GetChannels(); ++j) {
+            row.pmtID = phd.GetPMTID(j);
+            row.nHits = phd.GetEntries(j);
+            row.meanPE = phd.GetMean(j);
+            summary->Fill();
+            totalHits += row.nHits;
+        }
+        std::cout << "Config " << i << ": time [" << row.startTime << ", " << row.endTime << "], "
+                  << describeCuts(configs[i]) << ": " << totalHits << " hits" << std::endl;
+    }
+    outputFile->cd();
+    summary->Write();
+    outputFile->Close();
+    delete outputFile;
+    return true;
+}
+
+#endif // CutScan_H
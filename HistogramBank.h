@@ -0,0 +1,163 @@
+/*///////////////////////////////////////////////////////////////
+// Lazily allocated bank of per-PMT histograms                 //
+// For the ANNIE Collaboration                                 //
+///////////////////////////////////////////////////////////////*/
+
+// Booking a 10000 bin TH1D for every PMT up front costs ~80 kB per PMT and plot
+// whether the PMT fires or not, which adds up quickly with one set of plots per
+// thread or per cut configuration. HistogramBank holds one histogram per PMT with
+// a common binning, allocates a PMT's bins the first time it is filled and counts
+// with 32 bit integers. Binning and statistics follow TH1::Fill exactly, so the TH1D
+// made at write time is identical to one filled directly.
+
+#ifndef HistogramBank_H
+#define HistogramBank_H
+
+#include <TH1D.h>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+class HistogramBank {
+public:
+    HistogramBank() : fNBins(0), fXMin(0), fXMax(0) {}
+
+    // One channel per PMT ID; histograms are named namePrefix + PMT ID
+    void Setup(const std::vector<int>& pmtIDs, const char* namePrefix, int nBins, double xMin, double xMax) {
+        fPMTIDs = pmtIDs;
+        fNamePrefix = namePrefix;
+        fNBins = nBins;
+        fXMin = xMin;
+        fXMax = xMax;
+        fChannels.clear();
+        fChannels.resize(pmtIDs.size());
+    }
+
+    // Change the axis range; only allowed while the bank is empty
+    bool SetRange(double xMin, double xMax) {
+        if (xMin == fXMin && xMax == fXMax) return true;
+        if (!IsEmpty()) {
+            std::cerr << "Warning: " << fNamePrefix << " histograms already filled with range [" << fXMin << ", " << fXMax
+                      << "], keeping it." << std::endl;
+            return false;
+        }
+        fXMin = xMin;
+        fXMax = xMax;
+        return true;
+    }
+
+    // Same as TH1::Fill(x) on the histogram of the given channel
+    void Fill(int channel, double x) {
+        std::unique_ptr<Channel>& data = fChannels[channel];
+        if (!data) data.reset(new Channel(fNBins));
+        ++data->entries;
+        if (x < fXMin) {
+            ++data->counts[0];
+        } else if (!(x < fXMax)) {
+            ++data->counts[fNBins + 1];
+        } else {
+            ++data->counts[1 + int(fNBins * (x - fXMin) / (fXMax - fXMin))];
+            data->sumw += 1;
+            data->sumwx += x;
+            data->sumwx2 += x * x;
+        }
+    }
+
+    // Add the contents of a bank with the same channels and binning
+    void Add(const HistogramBank& other) {
+        if (other.fNBins != fNBins || other.fXMin != fXMin || other.fXMax != fXMax || other.fChannels.size() != fChannels.size()) {
+            std::cerr << "Error: Cannot add " << other.fNamePrefix << " histograms with different binning." << std::endl;
+            return;
+        }
+        for (size_t c = 0; c < fChannels.size(); ++c) {
+            const Channel* source = other.fChannels[c].get();
+            if (!source) continue;
+            std::unique_ptr<Channel>& data = fChannels[c];
+            if (!data) data.reset(new Channel(fNBins));
+            for (int bin = 0; bin < fNBins + 2; ++bin) {
+                data->counts[bin] += source->counts[bin];
+            }
+            data->entries += source->entries;
+            data->sumw += source->sumw;
+            data->sumwx += source->sumwx;
+            data->sumwx2 += source->sumwx2;
+        }
+    }
+
+    // Release all channels
+    void Clear() {
+        for (auto& data : fChannels) {
+            data.reset();
+        }
+    }
+
+    int GetChannels() const { return fChannels.size(); }
+    int GetPMTID(int channel) const { return fPMTIDs[channel]; }
+    bool HasHits(int channel) const { return fChannels[channel] != nullptr; }
+    Long64_t GetEntries(int channel) const { return fChannels[channel] ? fChannels[channel]->entries : 0; }
+    double GetXMin() const { return fXMin; }
+    double GetXMax() const { return fXMax; }
+
+    // Mean of the in-range fills, as TH1::GetMean
+    double GetMean(int channel) const {
+        const Channel* data = fChannels[channel].get();
+        return (data && data->sumw > 0) ? data->sumwx / data->sumw : 0;
+    }
+
+    bool IsEmpty() const {
+        for (const auto& data : fChannels) {
+            if (data) return false;
+        }
+        return true;
+    }
+
+    // Bytes held by the allocated channels
+    size_t GetMemoryUsage() const {
+        size_t bytes = 0;
+        for (const auto& data : fChannels) {
+            if (data) bytes += sizeof(Channel) + data->counts.size() * sizeof(uint32_t);
+        }
+        return bytes;
+    }
+
+    // Convert one channel to a TH1D (empty if the PMT never fired). The caller owns it;
+    // it is not attached to any directory. nameSuffix is appended to the name only.
+    TH1D* MakeTH1D(int channel, const char* nameSuffix = "") const {
+        std::string title = fNamePrefix + std::to_string(fPMTIDs[channel]);
+        std::string name = title + nameSuffix;
+        TH1D* hist = new TH1D(name.c_str(), title.c_str(), fNBins, fXMin, fXMax);
+        hist->SetDirectory(nullptr);
+        const Channel* data = fChannels[channel].get();
+        if (data) {
+            for (int bin = 0; bin < fNBins + 2; ++bin) {
+                if (data->counts[bin]) hist->SetBinContent(bin, data->counts[bin]);
+            }
+            // SetBinContent resets the statistics, so restore them afterwards
+            double stats[4] = {data->sumw, data->sumw, data->sumwx, data->sumwx2};
+            hist->PutStats(stats);
+            hist->SetEntries(data->entries);
+        }
+        return hist;
+    }
+
+private:
+    struct Channel {
+        explicit Channel(int nBins) : counts(nBins + 2, 0), entries(0), sumw(0), sumwx(0), sumwx2(0) {}
+        std::vector<uint32_t> counts; // Underflow, bins, overflow
+        Long64_t entries;
+        double sumw;                  // Unit weights, so sumw2 == sumw
+        double sumwx;
+        double sumwx2;
+    };
+
+    std::vector<int> fPMTIDs;
+    std::string fNamePrefix;
+    int fNBins;
+    double fXMin;
+    double fXMax;
+    std::vector<std::unique_ptr<Channel>> fChannels;
+};
+
+#endif // HistogramBank_H
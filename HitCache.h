@@ -0,0 +1,326 @@
+/*///////////////////////////////////////////////////////////////
+// Columnar cache of phaseIITriggerTree hits                   //
+// For the ANNIE Collaboration                                 //
+///////////////////////////////////////////////////////////////*/
+
+// Reading phaseIITriggerTree means decompressing every std::vector<double> branch
+// again on each pass. SkimHitCache writes the hit branches once into a flat file:
+//
+//   header | event offsets (uint64, nEvents+1) | hitDetID (int16) | hitQ | hitT | hitPE | hitX | hitY | hitZ (float)
+//
+// Every column is 64 byte aligned. HitCache maps the file into memory, so only the
+// columns an analysis actually touches are read from disk. They are read through page
+// faults while the histograms are filled, so the analyzers' stats count all of that
+// time as cut/fill rather than read. Values are stored as float,
+// which is plenty for cut tuning but means a hit sitting exactly on a bin edge or cut
+// value can land differently than when reading the doubles from the ROOT file.
+
+#ifndef HitCache_H
+#define HitCache_H
+
+#include <TFile.h>
+#include <TTree.h>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+enum HitCacheColumn { kHitDetID, kHitQ, kHitT, kHitPE, kHitX, kHitY, kHitZ, kHitCacheColumns };
+
+struct HitCacheHeader {
+    char magic[8];                          // "ANNIEHC1"
+    uint64_t nEvents;
+    uint64_t nHits;
+    uint64_t offsetsPos;                    // Byte position of the event offsets
+    uint64_t columnPos[kHitCacheColumns];   // Byte position of every column
+    char sourceFile[512];                   // ROOT file the cache was made from
+};
+
+static const char kHitCacheMagic[8] = {'A', 'N', 'N', 'I', 'E', 'H', 'C', '1'};
+
+class HitCache {
+public:
+    HitCache() : fData(nullptr), fSize(0), fHeader(nullptr), fOffsets(nullptr) {}
+    ~HitCache() { Close(); }
+
+    // Map a cache file into memory
+    bool Open(const char* fileName) {
+        Close();
+        int fd = open(fileName, O_RDONLY);
+        if (fd < 0) {
+            std::cerr << "Error: Failed to open hit cache: " << fileName << std::endl;
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(HitCacheHeader)) {
+            std::cerr << "Error: Not a hit cache: " << fileName << std::endl;
+            close(fd);
+            return false;
+        }
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            std::cerr << "Error: Failed to map hit cache: " << fileName << std::endl;
+            return false;
+        }
+        fData = static_cast<const char*>(data);
+        fSize = info.st_size;
+        fHeader = reinterpret_cast<const HitCacheHeader*>(fData);
+
+        // Check the layout fits in the file (the counts are bounded first so the sums
+        // cannot wrap around)
+        bool valid = memcmp(fHeader->magic, kHitCacheMagic, sizeof(kHitCacheMagic)) == 0 &&
+                     fHeader->nEvents < fSize / sizeof(uint64_t) && fHeader->nHits <= fSize &&
+                     fHeader->offsetsPos % sizeof(uint64_t) == 0 && fHeader->offsetsPos <= fSize &&
+                     fHeader->offsetsPos + (fHeader->nEvents + 1) * sizeof(uint64_t) <= fSize;
+        for (int c = 0; c < kHitCacheColumns && valid; ++c) {
+            valid = fHeader->columnPos[c] % ColumnWidth(c) == 0 && fHeader->columnPos[c] <= fSize &&
+                    fHeader->columnPos[c] + fHeader->nHits * ColumnWidth(c) <= fSize;
+        }
+
+        // GetSourceFile is used to name outputs, so it must be terminated
+        valid = valid && memchr(fHeader->sourceFile, '\0', sizeof(fHeader->sourceFile)) != nullptr;
+
+        // The event offsets must run from 0 to nHits without going back, or EventBegin and
+        // EventEnd would index past the columns
+        const uint64_t* offsets = reinterpret_cast<const uint64_t*>(fData + fHeader->offsetsPos);
+        if (valid) {
+            valid = offsets[0] == 0 && offsets[fHeader->nEvents] == fHeader->nHits;
+            for (uint64_t i = 0; i < fHeader->nEvents && valid; ++i) {
+                valid = offsets[i] <= offsets[i + 1];
+            }
+        }
+        if (!valid) {
+            std::cerr << "Error: Corrupt hit cache: " << fileName << std::endl;
+            Close();
+            return false;
+        }
+        fOffsets = offsets;
+        return true;
+    }
+
+    void Close() {
+        if (fData) munmap(const_cast<char*>(fData), fSize);
+        fData = nullptr;
+        fSize = 0;
+        fHeader = nullptr;
+        fOffsets = nullptr;
+    }
+
+    uint64_t GetEvents() const { return fHeader->nEvents; }
+    uint64_t GetHits() const { return fHeader->nHits; }
+    const char* GetSourceFile() const { return fHeader->sourceFile; }
+
+    // Hits of event i are [EventBegin(i), EventEnd(i)) in every column
+    uint64_t EventBegin(uint64_t i) const { return fOffsets[i]; }
+    uint64_t EventEnd(uint64_t i) const { return fOffsets[i + 1]; }
+
+    const int16_t* HitDetID() const { return reinterpret_cast<const int16_t*>(fData + fHeader->columnPos[kHitDetID]); }
+    const float* Column(HitCacheColumn c) const { return reinterpret_cast<const float*>(fData + fHeader->columnPos[c]); }
+
+    static size_t ColumnWidth(int c) { return c == kHitDetID ? sizeof(int16_t) : sizeof(float); }
+
+    // True if the file starts with the hit cache magic
+    static bool IsHitCache(const char* fileName) {
+        FILE* file = fopen(fileName, "rb");
+        if (!file) return false;
+        char magic[sizeof(kHitCacheMagic)];
+        bool isCache = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                       memcmp(magic, kHitCacheMagic, sizeof(magic)) == 0;
+        fclose(file);
+        return isCache;
+    }
+
+private:
+    HitCache(const HitCache&);
+    HitCache& operator=(const HitCache&);
+
+    const char* fData;
+    size_t fSize;
+    const HitCacheHeader* fHeader;
+    const uint64_t* fOffsets;
+};
+
+// Default cache name: run.root -> run.hitcache
+inline std::string HitCacheName(const char* rootFileName) {
+    std::string name(rootFileName);
+    if (name.size() > 5 && name.compare(name.size() - 5, 5, ".root") == 0) {
+        name.erase(name.size() - 5);
+    }
+    return name + ".hitcache";
+}
+
+// Temporary file in the directory of fileName, removed again when it is closed. The
+// skim stages a whole run there, so it goes to the disk that gets the cache rather
+// than to /tmp, which is often a small RAM disk.
+inline FILE* CreateStagingFile(const std::string& fileName) {
+    size_t slash = fileName.find_last_of('/');
+    std::string path = (slash == std::string::npos ? std::string(".") : fileName.substr(0, slash)) + "/.hitcache_XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    int fd = mkstemp(name.data());
+    if (fd < 0) return nullptr;
+    unlink(name.data());
+    FILE* file = fdopen(fd, "w+b");
+    if (!file) close(fd);
+    return file;
+}
+
+// Skim the hit branches of phaseIITriggerTree into a hit cache. Columns are first
+// streamed into temporary files next to the cache and then appended behind the header
+// and offsets, so the skim needs about twice the cache size on that disk.
+inline bool SkimHitCache(const char* rootFileName, const char* cacheFileName = nullptr) {
+    std::string cacheName = cacheFileName ? cacheFileName : HitCacheName(rootFileName);
+    if (strlen(rootFileName) >= sizeof(HitCacheHeader::sourceFile)) {
+        std::cerr << "Error: Input file name too long: " << rootFileName << std::endl;
+        return false;
+    }
+
+    TFile* file = TFile::Open(rootFileName);
+    if (!file || file->IsZombie()) {
+        std::cerr << "Error: Failed to open input file: " << rootFileName << std::endl;
+        return false;
+    }
+    TTree* tree = dynamic_cast<TTree*>(file->Get("phaseIITriggerTree"));
+    if (!tree) {
+        std::cerr << "Error: Failed to retrieve TTree 'phaseIITriggerTree' from file." << std::endl;
+        file->Close();
+        delete file;
+        return false;
+    }
+
+    // Only decompress the hit branches
+    const char* branches[kHitCacheColumns] = {"hitDetID", "hitQ", "hitT", "hitPE", "hitX", "hitY", "hitZ"};
+    tree->SetBranchStatus("*", false);
+    for (const char* branch : branches) {
+        tree->SetBranchStatus(branch, true);
+    }
+
+    std::vector<int>* hitDetID = nullptr;
+    std::vector<double>* values[kHitCacheColumns] = {nullptr};
+    tree->SetBranchAddress("hitDetID", &hitDetID);
+    for (int c = kHitQ; c < kHitCacheColumns; ++c) {
+        tree->SetBranchAddress(branches[c], &values[c]);
+    }
+
+    FILE* columns[kHitCacheColumns];
+    for (int c = 0; c < kHitCacheColumns; ++c) {
+        columns[c] = CreateStagingFile(cacheName);
+    }
+
+    std::vector<uint64_t> offsets(1, 0);
+    std::vector<int16_t> idBuffer;
+    std::vector<float> valueBuffer[kHitCacheColumns];
+    auto flush = [&]() {
+        fwrite(idBuffer.data(), sizeof(int16_t), idBuffer.size(), columns[kHitDetID]);
+        idBuffer.clear();
+        for (int c = kHitQ; c < kHitCacheColumns; ++c) {
+            fwrite(valueBuffer[c].data(), sizeof(float), valueBuffer[c].size(), columns[c]);
+            valueBuffer[c].clear();
+        }
+    };
+
+    bool ok = true;
+    for (int c = 0; c < kHitCacheColumns; ++c) {
+        ok = ok && columns[c];
+    }
+    if (!ok) {
+        std::cerr << "Error: Failed to create temporary files next to " << cacheName << std::endl;
+    }
+    Long64_t nentries = tree->GetEntries();
+    for (Long64_t jentry = 0; jentry < nentries && ok; jentry++) {
+        if (tree->LoadTree(jentry) < 0) break;
+        tree->GetEntry(jentry);
+
+        size_t nHits = hitDetID->size();
+        for (size_t k = 0; k < nHits; k++) {
+            int pmtID = (*hitDetID)[k];
+            if (pmtID < INT16_MIN || pmtID > INT16_MAX) {
+                std::cerr << "Error: hitDetID " << pmtID << " does not fit the cache format." << std::endl;
+                ok = false;
+                break;
+            }
+            idBuffer.push_back(pmtID);
+            for (int c = kHitQ; c < kHitCacheColumns; ++c) {
+                valueBuffer[c].push_back((*values[c])[k]);
+            }
+        }
+        offsets.push_back(offsets.back() + nHits);
+        if (ok && idBuffer.size() > (1 << 16)) flush();
+    }
+    if (ok) flush();
+
+    tree->ResetBranchAddresses();
+    delete hitDetID;
+    for (int c = kHitQ; c < kHitCacheColumns; ++c) {
+        delete values[c];
+    }
+    file->Close();
+    delete file;
+
+    // Lay out and write the cache
+    FILE* cache = ok ? fopen(cacheName.c_str(), "wb") : nullptr;
+    if (ok && !cache) {
+        std::cerr << "Error: Failed to create hit cache: " << cacheName << std::endl;
+        ok = false;
+    }
+    if (ok) {
+        auto align = [](uint64_t pos) { return (pos + 63) & ~uint64_t(63); };
+        HitCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, kHitCacheMagic, sizeof(kHitCacheMagic));
+        header.nEvents = offsets.size() - 1;
+        header.nHits = offsets.back();
+        strncpy(header.sourceFile, rootFileName, sizeof(header.sourceFile) - 1);
+        uint64_t pos = align(sizeof(header));
+        header.offsetsPos = pos;
+        pos = align(pos + offsets.size() * sizeof(uint64_t));
+        for (int c = 0; c < kHitCacheColumns; ++c) {
+            header.columnPos[c] = pos;
+            pos = align(pos + header.nHits * HitCache::ColumnWidth(c));
+        }
+
+        auto pad = [&](uint64_t target) {
+            static const char zeros[64] = {0};
+            long current = ftell(cache);
+            if (current >= 0 && (uint64_t)current < target) fwrite(zeros, 1, target - current, cache);
+        };
+
+        fwrite(&header, sizeof(header), 1, cache);
+        pad(header.offsetsPos);
+        fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), cache);
+        std::vector<char> block(1 << 20);
+        for (int c = 0; c < kHitCacheColumns; ++c) {
+            pad(header.columnPos[c]);
+            rewind(columns[c]);
+            size_t n;
+            while ((n = fread(block.data(), 1, block.size(), columns[c])) > 0) {
+                fwrite(block.data(), 1, n, cache);
+            }
+        }
+        if (ferror(cache)) {
+            std::cerr << "Error: Failed to write hit cache: " << cacheName << std::endl;
+            ok = false;
+        }
+        fclose(cache);
+        if (!ok) {
+            remove(cacheName.c_str());
+        } else {
+            std::cout << "Wrote " << header.nHits << " hits from " << header.nEvents << " events to " << cacheName << std::endl;
+        }
+    }
+
+    for (int c = 0; c < kHitCacheColumns; ++c) {
+        if (columns[c]) fclose(columns[c]);
+    }
+    return ok;
+}
+
+#endif // HitCache_H
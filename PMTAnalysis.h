@@ -15,45 +15,113 @@
 #include <TLegend.h>
 #include <vector>
 #include <string>
+#include "CutScan.h"
+#include "HistogramBank.h"
+#include "AnalysisStats.h"
+
+class HitCache;
+
+// Per-event work arrays of PMTAnalysis::FillHits. Every event loop keeps its own, so
+// they are reused from event to event and never shared between threads.
+struct PMTHitBuffers {
+    std::vector<unsigned char> pass;      // [configuration * nHits + hit]
+    std::vector<unsigned char> any;       // Hit passes some configuration
+    std::vector<uint32_t> selected;       // Hits passing some configuration
+    std::vector<double> x, y, z;          // Of the selected hits
+    std::vector<double> r, theta, phi;
+    std::vector<unsigned char> family;
+    std::vector<double> keptR, keptTheta, keptPhi; // Of the hits passing one configuration
+
+    void Reserve(size_t nHits, size_t nConfigs);
+};
+
+// Histograms filled by the event loop. AnalyzeParallel gives every worker
+// thread its own set and adds them together once all entries are processed.
+struct PMTHistogramSet {
+    TH1D* LUXhitfreq;
+    TH1D* ETELhitfreq;
+    TH1D* HAMAMATSUhitfreq;
+    TH1D* WATCHMANhitfreq;
+    TH1D* WATCHBOYhitfreq;
+    TH1D* RADIUShitfreq;
+    TH1D* THETAhitfreq;
+    TH1D* PHIhitfreq;
+    HistogramBank pulseHeightDistributions;
+    HistogramBank timingPlots;
+    std::string nameSuffix;
+
+    void Book(const std::string& suffix, double startTime, double endTime);
+    void SetTimingWindow(double startTime, double endTime);
+    void Add(const PMTHistogramSet& other);
+    void Write();
+    void Delete();
+};
 
 class PMTAnalysis {
 public:
     PMTAnalysis();  // Constructor
     virtual ~PMTAnalysis(); // Destructor
 
+    // fileName is either a ROOT file or a hit cache made with SkimHitCache (see HitCache.h)
     void Analyze(const char* fileName, double startTime, double endTime, double cutoffVoltage);
+
+    // Analyze several run files at once, splitting entries over nThreads worker threads
+    // (0 = one per core). filePattern may contain wildcards, e.g. "laser_run*.root".
+    void AnalyzeParallel(const char* filePattern, const char* outputFileName, double startTime, double endTime, double cutoffVoltage, int nThreads = 0);
+    void AnalyzeParallel(const std::vector<std::string>& fileNames, const char* outputFileName, double startTime, double endTime, double cutoffVoltage, int nThreads = 0);
+
+    // Fill one histogram set per cut configuration while reading the input only once, and
+    // write them with a per-PMT summary table to "PMTAnalysisScan_<input>". The cutOn field
+    // of the configurations is ignored.
+    void Scan(const char* fileName, const std::vector<CutConfig>& configs);
+
     std::vector<double> getSpherical(double hitX, double hitY, double hitZ);
-    
-    void saveHistogramsToPDF(const char* rootFileName, const char* pdfFileName);
-    
+
+    // Spherical co-ordinates of n points, written to caller-provided arrays
+    void getSpherical(const double* x, const double* y, const double* z, size_t n, double* r, double* theta, double* phi);
+
+    // Render the "_SummaryCanvases.pdf" report after writing the output (default). When
+    // off, make it later from the output file with saveHistogramsToPDF (see PMTReport.h).
+    void SetMakeReport(bool makeReport) { fMakeReport = makeReport; }
+
+    // Counters and stage timings of the last Analyze, AnalyzeParallel or Scan call
+    const AnalysisStats& GetStats() const { return fStats; }
+    void PrintStats() const { fStats.Print("PMTAnalysis"); }
+
     void GeneratePulseHeightDistributions();
     
     void GenerateTimingPlots();
 
 private:
+    // The microbenchmark times the hit kernel on its own
+    friend void benchHitKernel(int nEvents, int hitsPerEvent, int repeat, int nScanConfigs);
+
+    // Apply the cuts of every configuration to the hits of one event and fill its set
+    template <typename Id, typename Real>
+    void FillHits(size_t nHits, const Id* hitDetID, const Real* hitQ, const Real* hitT, const Real* hitPE,
+                  const Real* hitX, const Real* hitY, const Real* hitZ, const std::vector<CutConfig>& cuts,
+                  const std::vector<PMTHistogramSet*>& hists, PMTHitBuffers& buffers);
+    static std::string GetKernelBuild(bool& vectorized);
+
+    bool FillFromFile(const char* fileName, const std::vector<CutConfig>& cuts, const std::vector<PMTHistogramSet*>& hists, std::string& sourceFile);
+    void FillHistograms(TTree* tree, Long64_t firstEntry, Long64_t lastEntry, const std::vector<CutConfig>& cuts, const std::vector<PMTHistogramSet*>& hists, AnalysisStats& stats);
+    void FillHistograms(const HitCache& cache, Long64_t firstEvent, Long64_t lastEvent, const std::vector<CutConfig>& cuts, const std::vector<PMTHistogramSet*>& hists, AnalysisStats& stats);
+    void WriteOutput(const std::string& outputFileName);
+
     TTree* fChain;
     
     TH1D* allhitfreq;
-    TH1D* LUXhitfreq;
-    TH1D* ETELhitfreq;
-    TH1D* HAMAMATSUhitfreq;
-    TH1D* WATCHMANhitfreq;
-    TH1D* WATCHBOYhitfreq;
-    TH1D* RADIUShitfreq;
-    TH1D* THETAhitfreq;
-    TH1D* PHIhitfreq;
-    std::vector<TH1D*> pulseHeightDistributions;
-    std::vector<TH1D*> timingPlots;
+    PMTHistogramSet fHists;
 
     // Private member variables to store parameters
     const char* fFileName;
     double fStartTime;
     double fEndTime;
     double fCutoffVoltage;
+    bool fMakeReport;
+    AnalysisStats fStats;
 };
 
-void saveHistogramsToPDF(const char* rootFileName, const char* pdfFileName);
-
 #endif // PMTAnalysis_H
 
 
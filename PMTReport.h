@@ -0,0 +1,224 @@
+/*///////////////////////////////////////////////////////////////
+// Summary PDF of a PMTAnalysis output file                    //
+// For the ANNIE Collaboration                                 //
+///////////////////////////////////////////////////////////////*/
+
+// The report is rendered from the ROOT file written by PMTAnalysis, so it can be
+// (re)made at any time without reprocessing the run. Page 1 shows the hit
+// frequencies of all PMT families, followed by one page per three PMTs with their
+// pulse height distributions above their timing plots.
+//
+// Pages are split into groups that are rendered by separate processes
+// (ROOT::TProcessExecutor) into partial PDFs, which are then joined with
+// GhostScript. Without GhostScript, or with a single worker, all pages are rendered
+// in this process.
+
+#ifndef PMTReport_H
+#define PMTReport_H
+
+#include <TFile.h>
+#include <TH1D.h>
+#include <TKey.h>
+#include <TCanvas.h>
+#include <TLegend.h>
+#include <TColor.h>
+#include <TError.h>
+#include <TROOT.h>
+#include <TSystem.h>
+#include <ROOT/TProcessExecutor.hxx>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class PMTReport {
+public:
+    explicit PMTReport(const char* rootFileName) : fRootFileName(rootFileName), fHasHitFrequencies(false), fValid(false) {
+        fValid = ReadContents();
+    }
+
+    // Render the report. nWorkers = 0 uses one process per core, 1 renders serially.
+    bool Render(const char* pdfFileName, int nWorkers = 0) const {
+        if (!fValid) return false;
+
+        int nPages = GetPages();
+        if (nWorkers <= 0) {
+            nWorkers = std::max(1u, std::thread::hardware_concurrency());
+        }
+        nWorkers = std::min(nWorkers, nPages);
+
+        // ROOT prints an Info line for every page; only show warnings and errors
+        int ignoreLevel = gErrorIgnoreLevel;
+        gErrorIgnoreLevel = kWarning;
+        bool batch = gROOT->IsBatch();
+        gROOT->SetBatch(kTRUE);
+
+        bool ok = false;
+        char* gs = gSystem->Which(gSystem->Getenv("PATH"), "gs", kExecutePermission);
+        if (nWorkers > 1 && gs) {
+            ok = RenderParallel(pdfFileName, nPages, nWorkers, gs);
+            if (!ok) std::cerr << "Warning: Parallel rendering failed, rendering " << pdfFileName << " serially." << std::endl;
+        } else if (nWorkers > 1) {
+            std::cerr << "Warning: GhostScript not found, rendering " << pdfFileName << " serially." << std::endl;
+        }
+        delete[] gs;
+        if (!ok) {
+            ok = RenderPages(pdfFileName, 0, nPages);
+        }
+
+        gROOT->SetBatch(batch);
+        gErrorIgnoreLevel = ignoreLevel;
+
+        if (ok) std::cout << "Wrote " << nPages << " pages to " << pdfFileName << std::endl;
+        return ok;
+    }
+
+    int GetPages() const { return fHasHitFrequencies + (fPMTIDs.size() + 2) / 3; }
+
+private:
+    // Find the hit frequency histograms and the PMTs with a PHD in the file
+    bool ReadContents() {
+        TFile* file = TFile::Open(fRootFileName.c_str());
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error: Failed to open input file: " << fRootFileName << std::endl;
+            return false;
+        }
+        fHasHitFrequencies = file->Get("Histograms/LUXhitfreq") != nullptr;
+        TDirectory* phdDir = dynamic_cast<TDirectory*>(file->Get("PulseHeightDistributions"));
+        if (phdDir) {
+            TIter next(phdDir->GetListOfKeys());
+            while (TKey* key = static_cast<TKey*>(next())) {
+                int pmtID;
+                if (sscanf(key->GetName(), "PulseHeightDistribution_PMT%d", &pmtID) == 1 &&
+                    std::find(fPMTIDs.begin(), fPMTIDs.end(), pmtID) == fPMTIDs.end()) {
+                    fPMTIDs.push_back(pmtID);
+                }
+            }
+        }
+        file->Close();
+        delete file;
+
+        if (!fHasHitFrequencies && fPMTIDs.empty()) {
+            std::cerr << "Error: No PMTAnalysis histograms found in " << fRootFileName << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Render contiguous page groups in worker processes and join them
+    bool RenderParallel(const char* pdfFileName, int nPages, int nWorkers, const char* gs) const {
+        std::vector<int> groups;
+        std::vector<std::string> parts;
+        for (int g = 0; g < nWorkers; ++g) {
+            groups.push_back(g);
+            parts.push_back(std::string(pdfFileName) + Form(".part%d.pdf", g));
+        }
+
+        auto renderGroup = [&](int g) {
+            int firstPage = nPages * g / nWorkers;
+            int lastPage = nPages * (g + 1) / nWorkers;
+            return RenderPages(parts[g].c_str(), firstPage, lastPage) ? 1 : 0;
+        };
+        ROOT::TProcessExecutor pool(nWorkers);
+        std::vector<int> results = pool.Map(renderGroup, groups);
+
+        bool ok = results.size() == groups.size() && std::count(results.begin(), results.end(), 1) == nWorkers;
+        if (ok) {
+            std::string command = std::string(gs) + " -q -dNOPAUSE -dBATCH -sDEVICE=pdfwrite -sOutputFile='" + pdfFileName + "'";
+            for (const auto& part : parts) {
+                command += " '" + part + "'";
+            }
+            ok = gSystem->Exec(command.c_str()) == 0;
+        }
+        for (const auto& part : parts) {
+            gSystem->Unlink(part.c_str());
+        }
+        return ok;
+    }
+
+    // Render pages [firstPage, lastPage) into one PDF
+    bool RenderPages(const char* pdfFileName, int firstPage, int lastPage) const {
+        TFile* file = TFile::Open(fRootFileName.c_str());
+        if (!file || file->IsZombie()) {
+            std::cerr << "Error: Failed to open input file: " << fRootFileName << std::endl;
+            return false;
+        }
+
+        TCanvas* pdfCanvas = new TCanvas("SummaryPDFCanvas", "Summary Canvases in PDF", 800, 600);
+        pdfCanvas->Print(Form("%s[", pdfFileName));
+        for (int page = firstPage; page < lastPage; ++page) {
+            if (fHasHitFrequencies && page == 0) {
+                DrawHitFrequencies(file, pdfFileName);
+            } else {
+                DrawPMTs(file, 3 * (page - fHasHitFrequencies), pdfFileName);
+            }
+        }
+        pdfCanvas->Print(Form("%s]", pdfFileName));
+        delete pdfCanvas;
+
+        file->Close();
+        delete file;
+        return true;
+    }
+
+    // Combined hit frequencies of all PMT families
+    void DrawHitFrequencies(TFile* file, const char* pdfFileName) const {
+        TCanvas* allHitsCanvas = new TCanvas("AllHitsCanvas", "Combined PMT Hits", 800, 600);
+        TH1D* frame = new TH1D("ReportHitFrequencies", "Combined PMT Hits", 132, 332, 464);
+        frame->SetDirectory(nullptr);
+        frame->GetYaxis()->SetRangeUser(0, 130000);
+        frame->SetStats(0);
+        frame->Draw();
+
+        TLegend* legend = new TLegend(0.7, 0.7, 0.9, 0.9);
+        const char* families[][2] = {{"LUXhitfreq", "LUX (top)"},
+                                     {"ETELhitfreq", "ETEL (bottom)"},
+                                     {"HAMAMATSUhitfreq", "Hamamatsu (bottom)"},
+                                     {"WATCHBOYhitfreq", "Watchboy (bottom)"},
+                                     {"WATCHMANhitfreq", "Watchman (tank)"}};
+        for (const auto& family : families) {
+            TH1* hist = dynamic_cast<TH1*>(file->Get(Form("Histograms/%s", family[0])));
+            if (!hist) continue;
+            hist->Draw("SAME");
+            legend->AddEntry(hist, family[1], "f");
+        }
+        legend->Draw();
+        allHitsCanvas->Print(pdfFileName);
+
+        delete allHitsCanvas;
+        delete legend;
+        delete frame;
+    }
+
+    // PHDs of up to three PMTs above their timing plots
+    void DrawPMTs(TFile* file, int first, const char* pdfFileName) const {
+        int last = std::min<int>(first + 3, fPMTIDs.size());
+        TCanvas* summaryCanvas = new TCanvas(Form("SummaryCanvas_%d_to_%d", first, first + 2), "Summary Canvases", 1200, 800);
+        summaryCanvas->Divide(3, 2);
+        for (int j = first; j < last; ++j) {
+            TH1* phd = dynamic_cast<TH1*>(file->Get(Form("PulseHeightDistributions/PulseHeightDistribution_PMT%d", fPMTIDs[j])));
+            TH1* timing = dynamic_cast<TH1*>(file->Get(Form("TimingPlots/TimingPlot_PMT%d", fPMTIDs[j])));
+            summaryCanvas->cd(j - first + 1);
+            if (phd) phd->Draw();
+            summaryCanvas->cd(j - first + 4);
+            if (timing) timing->Draw();
+        }
+        summaryCanvas->Print(pdfFileName);
+        delete summaryCanvas;
+    }
+
+    std::string fRootFileName;
+    std::vector<int> fPMTIDs;
+    bool fHasHitFrequencies;
+    bool fValid;
+};
+
+// Render the report of rootFileName into pdfFileName
+inline void saveHistogramsToPDF(const char* rootFileName, const char* pdfFileName) {
+    PMTReport report(rootFileName);
+    report.Render(pdfFileName);
+}
+
+#endif // PMTReport_H
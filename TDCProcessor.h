@@ -8,6 +8,47 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <cstdio>
+#include <cfloat>
+#include <map>
+#include <string>
+#include "AnalysisStats.h"
+
+// Distinct tdc values with their multiplicity, in increasing order. Most values sit in a
+// sorted array of 16 bytes per value; values not seen before go to a small map that is
+// merged into the array once it holds an eighth as many, so adding one is amortized O(log n).
+class TDCValueStore {
+public:
+    typedef std::pair<double, Long64_t> Entry;
+
+    // Walks both parts in increasing order; they never hold the same value
+    class Cursor {
+    public:
+        Cursor(const TDCValueStore& store, double value); // At the first value >= value
+        bool AtEnd() const { return fSorted == fSortedEnd && fAdded == fAddedEnd; }
+        double Value() const { return FromAdded() ? fAdded->first : fSorted->first; }
+        Long64_t Count() const { return FromAdded() ? fAdded->second : fSorted->second; }
+        void Next();
+
+    private:
+        std::vector<Entry>::const_iterator fSorted, fSortedEnd;
+        std::map<double, Long64_t>::const_iterator fAdded, fAddedEnd;
+        bool FromAdded() const { return fAdded != fAddedEnd && (fSorted == fSortedEnd || fAdded->first < fSorted->first); }
+    };
+
+    void Add(double value, Long64_t count);
+    void Assign(std::vector<Entry>& values); // Takes over values, sorted and distinct
+    void Clear();
+    bool Empty() const { return fSorted.empty() && fAdded.empty(); }
+    double First() const { return Cursor(*this, -DBL_MAX).Value(); }
+    Cursor Find(double value) const { return Cursor(*this, value); }
+
+private:
+    std::vector<Entry> fSorted;
+    std::map<double, Long64_t> fAdded;
+
+    void Compact();
+};
 
 class TDCProcessor {
 public:
@@ -16,17 +57,78 @@ public:
 
     void SetFileName(const char* filename);
     void SetWindowSize(double window_size);
+    void SetMemoryBudget(size_t bytes); // 0 = sort everything in memory
+    void SetSpillDirectory(const char* directory); // nullptr or "" = $TMPDIR, else the current directory
+    void SetCheckpointFile(const char* filename); // nullptr or "" = TDCCheckpoint_<file> next to the input
     void Process();
+    void ProcessIncremental();
+
+    // Counters and stage timings of the last Process or ProcessIncremental call
+    const AnalysisStats& GetStats() const { return fStats; }
+    void PrintStats() const { fStats.Print("TDCProcessor"); }
 
 private:
     const char* fFileName; // File name
     double fWindowSize;    // Time window size
+    size_t fMemoryBudget;  // Bytes of tdc values held in memory when streaming
+    std::string fSpillDirectory; // Where streaming puts its temporary files
+
+    // Incremental state: every distinct tdc value seen with its multiplicity, the window
+    // groups over them keyed by the first value of each group, and the histogram of the
+    // group averages
+    struct Group {
+        double sum;
+        Long64_t count;
+    };
+    std::string fCheckpointFile;
+    bool fDefaultCheckpoint;     // fCheckpointFile follows the input file name
+    std::string fStateFileName;  // Input and checkpoint the state below belongs to
+    std::string fStateCheckpoint;
+    Long64_t fLastEntry;         // Entries of the tree already processed, -1 = not loaded
+    Long64_t fCommittedRows;     // Rows of the checkpoint's tdc_values tree in the state
+    double fStateWindowSize;     // Window size fGroups was built with
+    TDCValueStore fValueCounts;
+    std::map<double, Group> fGroups;
+    TH1D* fAverageHist;
+
+    AnalysisStats fStats;
 
     void ProcessTDC();
+    TH1D* AverageInMemory(TTree* tree);
+    TH1D* AverageStreaming(TTree* tree);
+    FILE* OpenSpillFile() const;
+    TH1D* BookAverageHistogram(double min_value, double max_value);
+    void ResetIncrementalState();
+    bool LoadCheckpoint();
+    bool SaveCheckpoint(const std::map<double, Long64_t>& new_counts);
+    Group NextGroup(TDCValueStore::Cursor& value) const;
+    void RegroupAll();
+    void Regroup(const std::map<double, Long64_t>& new_counts, std::vector<double>& removed, std::vector<double>& added);
+    void UpdateAverageHistogram(const std::vector<double>& removed, const std::vector<double>& added);
+};
+
+// Groups a sorted stream of values into windows of a fixed size and averages each group
+class TDCWindowGrouper {
+public:
+    TDCWindowGrouper(double window_size);
+
+    // Add the next value; returns true and sets average when this closes the previous group
+    bool Add(double value, double& average);
+    // Close the last group; returns false if no value was added
+    bool Finish(double& average);
+
+private:
+    double fWindowSize;
+    double fCurrentStart;
+    double fCurrentSum;
+    int fCount;
 };
 
 // Global function to use in ROOT
 extern "C" void process_tdc(const char* filename, double window_size);
+extern "C" void process_tdc_streaming(const char* filename, double window_size, double memory_budget_mb,
+                                      const char* spill_directory = nullptr);
+extern "C" void process_tdc_incremental(const char* filename, double window_size, const char* checkpoint_file);
 
 
 #endif // TDCPROCESSOR_H
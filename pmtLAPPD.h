@@ -15,35 +15,73 @@
 #include <TLegend.h>
 #include <vector>
 #include <string>
+#include "CutScan.h"
+#include "HistogramBank.h"
+#include "AnalysisStats.h"
+
+// One row of the LAPPD -> PMT mapping file: a PMT, the LAPPD it is grouped with and its family
+struct LAPPDMapEntry {
+    int pmtID;
+    int lappd;
+    std::string family;
+};
+
+// Dense lookup entry, indexed by hitDetID. slot < 0 means the PMT is not mapped.
+struct LAPPDDetectorSlot {
+    int slot;      // index into pulseHeightDistributions/timingPlots
+    int hitFreq;   // index into hitFreqHistograms (LAPPD group x family)
+};
+
+// Histograms filled by the event loop. Scan books one set per cut configuration.
+struct LAPPDHistogramSet {
+    std::vector<TH1D*> hitFreqHistograms; // [lappd * number of families + family]
+    HistogramBank pulseHeightDistributions;
+    HistogramBank timingPlots;
+    std::string nameSuffix;
+
+    void Delete();
+};
 
 class pmtLAPPD {
 public:
-    pmtLAPPD();  // Constructor
+    pmtLAPPD(const char* mapFileName = "pmtLAPPD_map.txt");  // Constructor
     virtual ~pmtLAPPD(); // Destructor
 
+    // fileName is either a ROOT file or a hit cache made with SkimHitCache (see HitCache.h)
     void Analyze(const char* fileName, double startTime, double endTime, double cutOnPE, double cutoffPE);
+
+    // Fill one histogram set per cut configuration while reading the input only once, and
+    // write them with a per-PMT summary table to "pmtLAPPDScan_<input>"
+    void Scan(const char* fileName, const std::vector<CutConfig>& configs);
+
+    // Counters and stage timings of the last Analyze or Scan call
+    const AnalysisStats& GetStats() const { return fStats; }
+    void PrintStats() const { fStats.Print("pmtLAPPD"); }
     
     void GeneratePulseHeightDistributions();
     
     void GenerateTimingPlots();
 
 private:
+    bool LoadMapping(const char* mapFileName);
+    void BuildDetectorTable();
+    void BookHistograms(LAPPDHistogramSet& hists, const std::string& suffix, double startTime, double endTime);
+    Long64_t FillFromFile(const char* fileName, const std::vector<CutConfig>& cuts, const std::vector<LAPPDHistogramSet*>& hists, std::string& sourceFile);
+    template <typename Id, typename Real>
+    void FillHits(size_t nHits, const Id* hitDetID, const Real* hitT, const Real* hitPE, const CutConfig& cuts, LAPPDHistogramSet& hists);
+    void WriteOutput(const std::string& outputFileName);
+
     TTree* fChain;
     
-    TH1D* HAMAMATSUpmtsByLAPPD64hitfreq;
-    TH1D* WATCHBOYpmtsByLAPPD64hitfreq;
-    TH1D* WATCHMANpmtsByLAPPD64hitfreq;
-    TH1D* HAMAMATSUpmtsByLAPPD58hitfreq;
-    TH1D* WATCHBOYpmtsByLAPPD58hitfreq;
-    TH1D* WATCHMANpmtsByLAPPD58hitfreq;
-    TH1D* HAMAMATSUpmtsByLAPPD39hitfreq;
-    TH1D* WATCHBOYpmtsByLAPPD39hitfreq;
-    TH1D* WATCHMANpmtsByLAPPD39hitfreq;
-    TH1D* pmtsByLAPPD64probabilityOfAhit;
-    TH1D* pmtsByLAPPD39probabilityOfAhit;
-    TH1D* pmtsByLAPPD58probabilityOfAhit;
-    std::vector<TH1D*> pulseHeightDistributions;
-    std::vector<TH1D*> timingPlots;
+    // Mapping, in the order of the mapping file
+    std::vector<LAPPDMapEntry> fMap;
+    std::vector<int> fLAPPDs;
+    std::vector<std::string> fFamilies;
+    std::vector<LAPPDDetectorSlot> fDetectorTable;
+    int fMinPMTID, fMaxPMTID; // Range of mapped PMTs, one hit frequency bin each
+
+    LAPPDHistogramSet fHists;
+    Long64_t fNEvents; // Events read by all Analyze calls, for normalizing hit frequencies
 
     // Private member variables to store parameters
     const char* fFileName;
@@ -51,9 +89,9 @@ private:
     double fEndTime;
     double fCutoffPE;
     double fCutOnPE;
-};
 
-void saveHistogramsToPDF(const char* rootFileName, const char* pdfFileName);
+    AnalysisStats fStats;
+};
 
 #endif // pmtLAPPD_H
 